@@ -0,0 +1,78 @@
+/**************************************************************************
+
+  Banked transfer buffer manager for the P112 FDISK utility.
+  Copyright (C) 2026, P112 FDISK contributors.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+***************************************************************************/
+
+#include "fdisk.h"
+
+/* Data that does not fit in the 64K logical address space of the
+   program can be kept in a region of physical RAM outside of it. The
+   region is accessed with the Z180 DMA. Nothing is reserved by
+   default: the memory around the program may belong to the OS, other
+   processes or a RAM disk, so the region is only set up when the user
+   names a free one with the -b option. Callers must cope with
+   bkavail() returning 0. */
+
+#define BK_PAGES  16     /* default region size, in 4K pages (64K) */
+
+static unsigned long bkbase;   /* physical address of the region */
+static unsigned long bksize;   /* region size in bytes, 0 if not set up */
+
+/* Set up the banked region to start at the given physical 4K page.
+   The region may not overlap the 64K segment the program is running
+   in. Returns the region size in bytes, 0 if the page is invalid. */
+
+unsigned long bkinit(unsigned page, unsigned npages)
+{
+    unsigned self;
+
+    bksize = 0;
+    if (npages == 0) npages = BK_PAGES;
+    if ((page == 0) || (page + npages > 256)) {
+        /* page 0 is low memory, and do not wrap around the
+           1M physical address space */
+        return 0;
+    }
+    self = bkpage((void *) 0);
+    if ((page < self + 16) && (page + npages > self)) return 0;
+    bkbase = (unsigned long) page << 12;
+    bksize = (unsigned long) npages << 12;
+    return bksize;
+}
+
+unsigned long bkavail()
+{
+    return bksize;
+}
+
+/* Copy n bytes from offset offs of the banked region to buf */
+
+int bkget(unsigned long offs, unsigned char *buf, unsigned n)
+{
+    if (offs + n > bkavail()) return 1;
+    return bkxfer(bkbase + offs, buf, n, 0);
+}
+
+/* Copy n bytes from buf to offset offs of the banked region */
+
+int bkput(unsigned long offs, unsigned char *buf, unsigned n)
+{
+    if (offs + n > bkavail()) return 1;
+    return bkxfer(bkbase + offs, buf, n, 1);
+}
@@ -0,0 +1,211 @@
+/**************************************************************************
+
+  Disk throughput benchmark for the P112 FDISK utility.
+  Copyright (C) 2026, P112 FDISK contributors.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "fdisk.h"
+
+#define NSEQ     256     /* sectors for the sequential tests (128K) */
+#define NRND     64      /* operations for the random access tests */
+#define NIDENT   16      /* identify commands */
+#define MULTI    16      /* sectors per multi-sector command (1 UZI track) */
+
+static unsigned long ticks;   /* accumulated PRT1 counts (20 clocks each) */
+static int wrapped;           /* an operation took longer than a wrap-around */
+static unsigned tmlast;
+static unsigned mhz;
+
+/* Only the time between tbeg() and tend() is counted. Each operation
+   is timed separately, but the 16-bit counter still wraps around after
+   65536 counts (82 ms at 16 MHz), e.g. on a seek or when the drive has
+   to spin up. Such results cannot be trusted and are not reported. */
+
+static void tbeg()
+{
+    tmlast = tmreset();
+}
+
+static void tend()
+{
+    unsigned now;
+
+    now = tmread();
+    if (tmwrap()) wrapped = 1;
+    ticks += (unsigned) (tmlast - now);   /* counts down */
+}
+
+static void report(char *name, unsigned nops, unsigned long nsec)
+{
+    unsigned long us, msx10;
+
+    if (wrapped) {
+        printf("  %-24s too slow to time\n", name);
+        ticks = 0;
+        wrapped = 0;
+        return;
+    }
+    us = ticks * 20L / mhz;
+    if (us == 0) us = 1;
+    msx10 = us / nops / 100L;
+    if (nsec > 0) {
+        printf("  %-24s %6lu %6lu %5lu.%lu\n", name,
+               (unsigned long) nops * 1000000L / us,
+               nsec * 500000L / us, msx10 / 10, msx10 % 10);
+    } else {
+        printf("  %-24s %6lu %6s %5lu.%lu\n", name,
+               (unsigned long) nops * 1000000L / us,
+               "-", msx10 / 10, msx10 % 10);
+    }
+    ticks = 0;
+}
+
+static unsigned long rndsec(unsigned long size)
+{
+    return (((unsigned long) rand() << 15) | rand()) % size;
+}
+
+/* The write tests rewrite each sector with the data just read from it,
+   so the partition contents are preserved. Returns nonzero on errors. */
+
+static int run_tests(unsigned long start, unsigned long size,
+                     unsigned char *buf)
+{
+    unsigned i, nseq;
+    unsigned long lba;
+
+    nseq = (size < NSEQ) ? size : NSEQ;
+    nseq -= nseq % MULTI;
+
+    ticks = 0;
+    wrapped = 0;
+    for (i = 0; i < NIDENT; ++i) {
+        tbeg();
+        if (hdident(buf)) return 1;
+        tend();
+    }
+    report("Identify", NIDENT, 0);
+
+    for (i = 0; i < nseq; ++i) {
+        tbeg();
+        if (lbaread(start + i, buf)) return 1;
+        tend();
+    }
+    report("Seq read, 1 sector", nseq, nseq);
+
+    for (i = 0; i < nseq; i += MULTI) {
+        tbeg();
+        if (lbareadm(start + i, MULTI, buf)) return 1;
+        tend();
+    }
+    report("Seq read, 16 sectors", nseq / MULTI, nseq);
+
+    for (i = 0; i < NRND; ++i) {
+        lba = start + rndsec(size);
+        tbeg();
+        if (lbaread(lba, buf)) return 1;
+        tend();
+    }
+    report("Random read", NRND, NRND);
+
+    for (i = 0; i < nseq; ++i) {
+        if (lbaread(start + i, buf)) return 1;
+        tbeg();
+        if (lbawrite(start + i, buf)) return 1;
+        tend();
+    }
+    report("Seq write, 1 sector", nseq, nseq);
+
+    for (i = 0; i < nseq; i += MULTI) {
+        if (lbareadm(start + i, MULTI, buf)) return 1;
+        tbeg();
+        if (lbawritem(start + i, MULTI, buf)) return 1;
+        tend();
+    }
+    report("Seq write, 16 sectors", nseq / MULTI, nseq);
+
+    for (i = 0; i < NRND; ++i) {
+        lba = start + rndsec(size);
+        if (lbaread(lba, buf)) return 1;
+        tbeg();
+        if (lbawrite(lba, buf)) return 1;
+        tend();
+    }
+    report("Random write", NRND, NRND);
+
+    return 0;
+}
+
+void benchmark()
+{
+    int  n, err;
+    unsigned long start, size;
+    unsigned char *buf;
+    char str[20];
+
+    printf("Partition number (1-%d): ", MAX_ENTRIES);
+    fgets(str, 20, stdin);
+    n = atoi(str);
+    if ((n < 1) || (n > MAX_ENTRIES)) {
+        printf("Value out of range.\n\n");
+        return;
+    }
+    size = part_extent(n - 1, &start);
+    if (size == 0) {
+        printf("Partition %d does not exist yet.\n\n", n);
+        return;
+    }
+
+    printf("CPU clock in MHz (default 16): ");
+    fgets(str, 20, stdin);
+    mhz = atoi(str);
+    if (mhz == 0) mhz = 16;
+
+    printf("The write tests rewrite sectors of partition %d with their own\n", n);
+    printf("contents. Make sure it is not in use. Proceed (y/n)? ");
+    fgets(str, 20, stdin);
+    if (tolower(str[0]) != 'y') {
+        printf("\n");
+        return;
+    }
+
+    buf = malloc(MULTI * 512);
+    if (!buf) {
+        printf("Not enough memory.\n\n");
+        return;
+    }
+    if (tmstart()) {
+        printf("The PRT1 timer is in use, cannot run the benchmark.\n\n");
+        free(buf);
+        return;
+    }
+
+    printf("\n");
+    printf("  %-24s %6s %6s %7s\n", "Test", "ops/s", "KB/s", "ms/op");
+    printf("  %-24s %6s %6s %7s\n", "----", "-----", "----", "-----");
+    err = run_tests(start, size, buf);
+    tmstop();
+    free(buf);
+
+    if (err) printf("Hard disk failure, benchmark aborted.\n");
+    printf("\n");
+}
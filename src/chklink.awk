@@ -0,0 +1,62 @@
+# Check the memory layout of a linked fdisk, using the symbol file
+# written by the linker (-D option):
+#
+#   awk -v heap=<bytes> -v top=<hex> -f chklink.awk fdisk.sym
+#
+# The boot loader psects are linked at 8000h and 0C000h but loaded
+# right after the data psect, and bss is linked at a fixed address.
+# Fail if text, data and the loader code do not end below bss, or if
+# bss plus the heap the program needs do not fit below top.
+
+function hex(s,    i, n, c)
+{
+    n = 0
+    s = toupper(s)
+    sub(/H$/, "", s)
+    for (i = 1; i <= length(s); ++i) {
+        c = index("0123456789ABCDEF", substr(s, i, 1))
+        if (c == 0) return -1
+        n = n * 16 + c - 1
+    }
+    return n
+}
+
+{
+    for (i = 1; i <= NF; ++i) {
+        if ($i !~ /^__[LH][a-z]+$/) continue
+        for (j = NF; j > 0; --j) {
+            if ((j != i) && ((v = hex($j)) >= 0)) {
+                sym[$i] = v
+                break
+            }
+        }
+    }
+}
+
+END {
+    if (!("__Hdata" in sym) || !("__Lbss" in sym) || !("__Hbss" in sym)) {
+        printf("chklink: no psect symbols in %s, layout not checked\n",
+               FILENAME)
+        exit 0
+    }
+    end = sym["__Hdata"]
+    split("ldboot boot ldnboot nboot", ldr, " ")
+    for (i = 1; i <= 4; ++i) {
+        if (("__L" ldr[i]) in sym)
+            end += sym["__H" ldr[i]] - sym["__L" ldr[i]]
+    }
+    if (end > sym["__Lbss"]) {
+        printf("chklink: code and data end at %04Xh, above bss at %04Xh.\n",
+               end, sym["__Lbss"])
+        printf("chklink: set BSS in the Makefile to at least %04Xh.\n", end)
+        exit 1
+    }
+    if (sym["__Hbss"] + heap > hex(top)) {
+        printf("chklink: bss ends at %04Xh, no room for %u bytes of heap\n",
+               sym["__Hbss"], heap)
+        printf("chklink: below %s, the program is too big.\n", top)
+        exit 1
+    }
+    printf("chklink: code and data end at %04Xh, bss %04Xh-%04Xh\n",
+           end, sym["__Lbss"], sym["__Hbss"])
+}
@@ -0,0 +1,341 @@
+/**************************************************************************
+
+  Seekable compressed disk image support for the host version of the
+  P112 FDISK utility.
+  Copyright (C) 2026, P112 FDISK contributors.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+***************************************************************************/
+
+/* The image is split into chunks of one UZI track (16 sectors), each
+   compressed on its own, so any sector can be read or rewritten by
+   touching a single chunk. File layout:
+
+     header   32 bytes: 'P112CIMG', version (word), reserved (word),
+              chunk size (dword), image size (qword), number of chunks
+              (dword), reserved (dword)
+     index    16 bytes per chunk: file offset (qword), stored length
+              (dword), allocated length (word), method (byte), reserved
+     data     the stored chunks, in any order
+
+   All values are little-endian. Chunks that are all zeros have no data.
+   A rewritten chunk is always appended to the end of the file before
+   its index entry is changed, so an interrupted write leaves the old
+   contents in place. The space of the old copy is not reused; running
+   the image through decompress and compress again drops it. */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "fdisk.h"
+
+#define CI_MAGIC    "P112CIMG"
+#define CI_VERSION  1
+#define CI_CHUNK    8192
+#define CI_HDRSZ    32
+#define CI_ENTSZ    16
+
+#define CH_ZERO     0     /* all zeros, nothing stored */
+#define CH_RAW      1     /* stored as is */
+#define CH_RLE      2     /* PackBits-style run-length encoding */
+
+/* worst case RLE output: one control byte per 128 literals */
+#define CI_MAXLEN   (CI_CHUNK + CI_CHUNK / 128)
+
+struct chunk {
+    off_t    offs;
+    unsigned len;
+    unsigned room;
+    int      method;
+};
+
+static int   cifd = -1;
+static off_t cisize, ciend;
+static unsigned long cinum;
+static struct chunk *ciidx;
+
+static unsigned char cbuf[CI_CHUNK];   /* last chunk accessed */
+static long ccur = -1;
+static unsigned char zbuf[CI_MAXLEN];
+
+static void putle(unsigned char *p, unsigned long long v, int n)
+{
+    while (n-- > 0) {
+        *p++ = v & 0xFF;
+        v >>= 8;
+    }
+}
+
+static unsigned long long getle(unsigned char *p, int n)
+{
+    unsigned long long v;
+
+    v = 0;
+    while (n-- > 0) v = (v << 8) | p[n];
+    return v;
+}
+
+/* Run-length encode a chunk, returns the encoded length */
+
+static unsigned rle_pack(unsigned char *src, unsigned char *dst)
+{
+    unsigned i, j, n, lit;
+
+    n = 0;
+    i = 0;
+    while (i < CI_CHUNK) {
+        for (j = i + 1; (j < CI_CHUNK) && (j - i < 128) && (src[j] == src[i]); ++j) ;
+        if (j - i >= 3) {
+            dst[n++] = 257 - (j - i);
+            dst[n++] = src[i];
+            i = j;
+        } else {
+            /* collect literals until the next run of 3 or more */
+            lit = n++;
+            for (j = i; (j < CI_CHUNK) && (j - i < 128); ++j) {
+                if ((j + 2 < CI_CHUNK) &&
+                    (src[j] == src[j+1]) && (src[j] == src[j+2])) break;
+                dst[n++] = src[j];
+            }
+            dst[lit] = j - i - 1;
+            i = j;
+        }
+    }
+    return n;
+}
+
+static int rle_unpack(unsigned char *src, unsigned len, unsigned char *dst)
+{
+    unsigned i, n, c;
+
+    n = 0;
+    i = 0;
+    while (i < len) {
+        c = src[i++];
+        if (c < 128) {
+            if ((i + c + 1 > len) || (n + c + 1 > CI_CHUNK)) return 1;
+            memcpy(dst + n, src + i, c + 1);
+            i += c + 1;
+            n += c + 1;
+        } else if (c > 128) {
+            if ((i >= len) || (n + 257 - c > CI_CHUNK)) return 1;
+            memset(dst + n, src[i++], 257 - c);
+            n += 257 - c;
+        }
+    }
+    return n != CI_CHUNK;
+}
+
+static int write_entry(unsigned long n)
+{
+    unsigned char e[CI_ENTSZ];
+
+    memset(e, 0, sizeof(e));
+    putle(e, ciidx[n].offs, 8);
+    putle(e + 8, ciidx[n].len, 4);
+    putle(e + 12, ciidx[n].room, 2);
+    e[14] = ciidx[n].method;
+    return pwrite(cifd, e, CI_ENTSZ, CI_HDRSZ + n * CI_ENTSZ) != CI_ENTSZ;
+}
+
+/* Load chunk n into the chunk buffer */
+
+static int load_chunk(unsigned long n)
+{
+    struct chunk *c;
+
+    if (ccur == n) return 0;
+    ccur = -1;
+    c = &ciidx[n];
+    switch (c->method) {
+    case CH_ZERO:
+        memset(cbuf, 0, CI_CHUNK);
+        break;
+
+    case CH_RAW:
+        if (pread(cifd, cbuf, CI_CHUNK, c->offs) != CI_CHUNK) return 1;
+        break;
+
+    case CH_RLE:
+        if ((c->len > CI_MAXLEN) ||
+            (pread(cifd, zbuf, c->len, c->offs) != c->len)) return 1;
+        if (rle_unpack(zbuf, c->len, cbuf)) return 1;
+        break;
+
+    default:
+        return 1;
+    }
+    ccur = n;
+    return 0;
+}
+
+/* Compress and store the chunk buffer as chunk n */
+
+static int store_chunk(unsigned long n)
+{
+    struct chunk *c;
+    unsigned char *data;
+    unsigned i, len;
+    int method;
+
+    c = &ciidx[n];
+    for (i = 0; (i < CI_CHUNK) && (cbuf[i] == 0); ++i) ;
+    if (i == CI_CHUNK) {
+        c->method = CH_ZERO;
+        c->len = 0;
+        return write_entry(n);
+    }
+
+    len = rle_pack(cbuf, zbuf);
+    if (len < CI_CHUNK) {
+        method = CH_RLE;
+        data = zbuf;
+    } else {
+        method = CH_RAW;
+        data = cbuf;
+        len = CI_CHUNK;
+    }
+
+    /* never overwrite the stored copy, chunk 0 holds the boot record */
+    if (pwrite(cifd, data, len, ciend) != len) return 1;
+    c->offs = ciend;
+    c->method = method;
+    c->room = len;
+    c->len = len;
+    ciend += len;
+    return write_entry(n);
+}
+
+/* Check whether fd is a compressed image and, if so, load its index.
+   Returns 1 if it is, 0 if not, -1 on errors. */
+
+int ci_open(int fd)
+{
+    unsigned char h[CI_HDRSZ], *e;
+    struct stat st;
+    unsigned long n;
+
+    if ((pread(fd, h, CI_HDRSZ, 0) != CI_HDRSZ) ||
+        (memcmp(h, CI_MAGIC, 8) != 0)) return 0;
+    if ((getle(h + 8, 2) != CI_VERSION) ||
+        (getle(h + 12, 4) != CI_CHUNK) || (fstat(fd, &st) < 0)) return -1;
+
+    cisize = getle(h + 16, 8);
+    cinum = getle(h + 24, 4);
+    if (cinum != (cisize + CI_CHUNK - 1) / CI_CHUNK) return -1;
+
+    free(ciidx);
+    ciidx = calloc(cinum + 1, sizeof(struct chunk));
+    e = malloc(cinum * CI_ENTSZ + 1);
+    if (!ciidx || !e ||
+        (pread(fd, e, cinum * CI_ENTSZ, CI_HDRSZ) != cinum * CI_ENTSZ)) {
+        free(e);
+        return -1;
+    }
+    for (n = 0; n < cinum; ++n) {
+        ciidx[n].offs = getle(e + n * CI_ENTSZ, 8);
+        ciidx[n].len = getle(e + n * CI_ENTSZ + 8, 4);
+        ciidx[n].room = getle(e + n * CI_ENTSZ + 12, 2);
+        ciidx[n].method = e[n * CI_ENTSZ + 14];
+    }
+    free(e);
+
+    cifd = fd;
+    ciend = st.st_size;
+    ccur = -1;
+    return 1;
+}
+
+/* Initialize a new, empty compressed image of the given size on fd */
+
+int ci_create(int fd, off_t size)
+{
+    unsigned char h[CI_HDRSZ];
+    unsigned long n;
+
+    n = (size + CI_CHUNK - 1) / CI_CHUNK;
+    memset(h, 0, sizeof(h));
+    memcpy(h, CI_MAGIC, 8);
+    putle(h + 8, CI_VERSION, 2);
+    putle(h + 12, CI_CHUNK, 4);
+    putle(h + 16, size, 8);
+    putle(h + 24, n, 4);
+    if ((ftruncate(fd, 0) < 0) ||
+        (ftruncate(fd, CI_HDRSZ + n * CI_ENTSZ) < 0) ||
+        (pwrite(fd, h, CI_HDRSZ, 0) != CI_HDRSZ)) return 1;
+    return ci_open(fd) != 1;
+}
+
+off_t ci_size()
+{
+    return cisize;
+}
+
+/* Read n bytes at the given image offset, past the end reads zeros */
+
+int ci_read(off_t offs, unsigned char *buf, size_t n)
+{
+    unsigned long ch;
+    size_t k, pos;
+
+    while (n > 0) {
+        ch = offs / CI_CHUNK;
+        pos = offs % CI_CHUNK;
+        k = CI_CHUNK - pos;
+        if (k > n) k = n;
+        if (ch >= cinum) {
+            memset(buf, 0, k);
+        } else {
+            if (load_chunk(ch)) return 1;
+            memcpy(buf, cbuf + pos, k);
+        }
+        buf += k;
+        offs += k;
+        n -= k;
+    }
+    return 0;
+}
+
+/* Write n bytes at the given image offset, each affected chunk is
+   recompressed and stored right away */
+
+int ci_write(off_t offs, unsigned char *buf, size_t n)
+{
+    unsigned long ch;
+    size_t k, pos;
+
+    while (n > 0) {
+        ch = offs / CI_CHUNK;
+        pos = offs % CI_CHUNK;
+        k = CI_CHUNK - pos;
+        if (k > n) k = n;
+        if (ch >= cinum) return 1;
+        if (k < CI_CHUNK) {
+            if (load_chunk(ch)) return 1;
+        }
+        memcpy(cbuf + pos, buf, k);
+        ccur = ch;
+        if (store_chunk(ch)) return 1;
+        buf += k;
+        offs += k;
+        n -= k;
+    }
+    return 0;
+}
@@ -22,13 +22,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+
+#include "fdisk.h"
 
 #define UNITS_SECTORS    0
 #define UNITS_UZITRACKS  1
 #define UNITS_CYLINDERS  2
 
-#define MAX_ENTRIES      8
-
 struct EntryType {
     unsigned char code;
     char *name;
@@ -55,7 +56,6 @@ struct EntryType entry_types[] = {
 
 void print_menu();
 void ide_geometry();
-void read_ptable();
 void write_ptable();
 void change_units();
 void show_partitions();
@@ -69,6 +69,9 @@ void set_type();
 void toggle_bootable();
 void toggle_method();
 void verify_table();
+void check_fs();
+void select_loader();
+int  load_loader(char *name, int meth, unsigned char *buf);
 
 unsigned char hdbuf[1024];         /* new-style boot code is 2 sectors long */
 
@@ -79,6 +82,12 @@ unsigned int idecyls, ideheads, idesecs; /* disk geometry, as reported by the di
 int  units, valid, idok;
 int  method, ptoffs, goffs, sgnoffs;
 char *filename;
+char *ldrfile;                     /* boot loader file set by the user */
+char ldrpath[80];
+
+/* Default boot loader image files, as built by the Makefile */
+
+char *ldrname[] = { "hdboot", "hdnboot" };
 
 /* The partition table */
 
@@ -120,30 +129,55 @@ struct IDRecord {
 
 struct IDRecord idbuf;
 
-/* Functions defined in gideio.asz */
-
-extern int hdident(struct IDRecord *buf);
-extern int hdread(int cyl, int head, int sector, unsigned char *buf);
-extern int hdwrite(int cyl, int head, int sector, unsigned char *buf);
-
-
+#ifndef NOLDR
 /* from linker, location of boot loader assembly code */
 extern unsigned char *_Bldboot,  *_Lldboot,  *_Hldboot; /* old-style loader */
 extern unsigned char *_Bboot,    *_Lboot,    *_Hboot;
 
 extern unsigned char *_Bldnboot, *_Lldnboot, *_Hldnboot; /* new-style loader */
 extern unsigned char *_Bnboot,   *_Lnboot,   *_Hnboot;
+#endif
 
 int main(int argc, char *argv[])
 {
     FILE *f;
+    int  i;
+    unsigned bkpg;
     char cmd[100];
 
+#ifdef HOST
+    /* non-interactive image file commands */
+    if ((argc > 1) && (argv[1][0] != '-')) {
+        i = hostcmd(argc - 1, argv + 1);
+        if (i >= 0) return i;
+    }
+#endif
+
     printf("P112 FDISK version 1.2 (GIDE)\n");
 
     filename = NULL;
-    if (argc > 1) {
-        filename = argv[1];
+    for (i = 1; i < argc; ++i) {
+        if ((argv[i][0] == '-') && (tolower(argv[i][1]) == 'b')) {
+            /* physical 4K page where the banked buffers should go */
+            if ((sscanf(argv[i]+2, "%x", &bkpg) != 1) ||
+                (bkinit(bkpg, 0) == 0)) {
+                fprintf(stderr, "Invalid bank page %s.\n", argv[i]+2);
+                return 1;
+            }
+        } else {
+#ifdef HOST
+            /* the host version works on whole disk images */
+            if (hdopen(argv[i], 0)) {
+                fprintf(stderr, "Could not open file %s.\n", argv[i]);
+                return 1;
+            }
+#else
+            filename = argv[i];
+#endif
+        }
+    }
+
+    if (filename) {
         f = fopen(filename, "rb");
         if (!f) {
             fprintf(stderr, "Could not open file %s.\n", filename);
@@ -186,10 +220,18 @@ int main(int argc, char *argv[])
             toggle_bootable();
             break;
 
+        case 'c':
+            check_fs();
+            break;
+
         case 'd':
             delete_partition();
             break;
 
+        case 'f':
+            select_loader();
+            break;
+
         case 'l':
             list_types();
             break;
@@ -209,6 +251,16 @@ int main(int argc, char *argv[])
         case 'q':
             return 0;
 
+        case 'r':
+            scan_part();
+            break;
+
+#ifndef HOST
+        case 's':
+            benchmark();
+            break;
+#endif
+
         case 't':
             set_type();
             break;
@@ -240,13 +292,19 @@ void print_menu()
     printf("\n");
     printf("Command action\n");
     printf("   b    toggle a bootable flag\n");
+    printf("   c    check an UZI filesystem\n");
     printf("   d    delete a partition\n");
+    printf("   f    select boot loader file\n");
     printf("   h    print this menu\n");
     printf("   l    list known partition types\n");
     printf("   m    toggle boot code method\n");
     printf("   n    add a new partition\n");
     printf("   p    print the partition table\n");
     printf("   q    quit without saving\n");
+    printf("   r    read-check a partition and show its checksum\n");
+#ifndef HOST
+    printf("   s    measure disk speed on a partition\n");
+#endif
     printf("   t    change a partition's system id\n");
     printf("   u    change display/entry units\n");
     printf("   v    verify the partition table\n");
@@ -287,7 +345,7 @@ void ide_geometry()
 void read_ptable()
 {
     int i;
-    unsigned int  bootsz, cyls, heads, sectors, *p;
+    unsigned int  bootsz, cyls, heads, sectors, w;
     unsigned char cks, *b;
 
     valid = 1;
@@ -340,10 +398,10 @@ void read_ptable()
         /* shouldn't we check for the version number as well? */
         if (valid) {
             /* looks OK so far, let's do some safety checks */
-            p = (int *) &hdbuf[ptoffs];
-            if ((*p < 7) || (*p > bootsz)) valid = 0;
-            p = (int *) &hdbuf[goffs];
-            if ((*p < 7) || (*p > bootsz)) valid = 0;
+            w = getword(&hdbuf[ptoffs]);
+            if ((w < 7) || (w > bootsz)) valid = 0;
+            w = getword(&hdbuf[goffs]);
+            if ((w < 7) || (w > bootsz)) valid = 0;
         }
     } else {
         valid = 0;
@@ -361,25 +419,22 @@ void read_ptable()
         return;
     }
 
-    p = (int *) &hdbuf[goffs];
-    p = (int *) &hdbuf[*p];
-    b = (unsigned char *) p;
+    b = &hdbuf[getword(&hdbuf[goffs])];
     
-    cyls = *p;
+    cyls = getword(b);
     heads = *(b+2);
     sectors = *(b+3);
 
     /* we should still check for a valid disk geometry definition */
 
-    p = (int *) &hdbuf[ptoffs];
-    p = (int *) &hdbuf[*p];
+    b = &hdbuf[getword(&hdbuf[ptoffs])];
 
     for (i = 0; i < MAX_ENTRIES; ++i) {
-        ptable[i].start = *p++;
-        ptable[i].size = *p++;
-        b = (unsigned char *) p++;
-        ptable[i].type = *b++;
-        ptable[i].bflag = *b;
+        ptable[i].start = getword(b);
+        ptable[i].size = getword(b+2);
+        ptable[i].type = *(b+4);
+        ptable[i].bflag = *(b+5);
+        b += 6;
     }
 
     hdcyls = cyls;
@@ -390,30 +445,51 @@ void read_ptable()
 void write_ptable()
 {
     FILE *f;
-    int  i, cks, *p, boot_size, max_size;
-    unsigned char *boot_code, *b;
-    
-    if (method == METHOD_BP) {
-        boot_code = (unsigned char *) &_Bldnboot;
-        boot_size = (int) &_Hldnboot - (int) &_Lldnboot +
-                    (int) &_Hnboot - (int) &_Lnboot;   /* ugly, ugly... */
+    int  i, cks, boot_size, max_size;
+    unsigned char *boot_code, *b, *ldrbuf;
+    char *name;
+
+    /* try the boot loader image file first */
+
+    name = ldrfile ? ldrfile : ldrname[method];
+    ldrbuf = malloc(1024);
+    boot_size = ldrbuf ? load_loader(name, method, ldrbuf) : 0;
+    if (boot_size > 0) {
+        boot_code = ldrbuf;
+        printf("Using boot loader code from file %s\n", name);
     } else {
-        boot_code = (unsigned char *) &_Bldboot;
-        boot_size = (int) &_Hldboot - (int) &_Lldboot +
-                    (int) &_Hboot - (int) &_Lboot;
+#ifdef NOLDR
+        printf("File %s is missing or not a valid boot loader.\n", name);
+        boot_code = NULL;
+        boot_size = 0;
+#else
+        printf("File %s is missing or not a valid boot loader, "
+               "using built-in code.\n", name);
+        if (method == METHOD_BP) {
+            boot_code = (unsigned char *) &_Bldnboot;
+            boot_size = (int) &_Hldnboot - (int) &_Lldnboot +
+                        (int) &_Hnboot - (int) &_Lnboot;   /* ugly, ugly... */
+        } else {
+            boot_code = (unsigned char *) &_Bldboot;
+            boot_size = (int) &_Hldboot - (int) &_Lldboot +
+                        (int) &_Hboot - (int) &_Lboot;
+        }
+#endif
     }
 
     if (method == METHOD_STD) {
         /* This is not suppossed to happen, but we'll check anyway... */
         max_size = 512;
         if ((boot_size <= 0) || (boot_size > max_size)) {
-            printf("Internal error: boot loader code size is %d\n", boot_size);
+            if (boot_size == 0)
+                printf("No boot loader code available.\n");
+            else
+                printf("Internal error: boot loader code size is %d\n", boot_size);
             if (valid) {
                 printf("Using original boot loader code.\n");
             } else {
                 printf("Unable to write new partition table.\n\n");
-                /* perhaps we should allow the user to specify a filename
-                   containing a valid boot loader */
+                free(ldrbuf);
                 return;
             }
         } else {
@@ -425,13 +501,15 @@ void write_ptable()
     } else {
         max_size = 1024;
         if ((boot_size <= 0) || (boot_size > max_size)) {
-            printf("Internal error: boot loader code size is %d\n", boot_size);
+            if (boot_size == 0)
+                printf("No boot loader code available.\n");
+            else
+                printf("Internal error: boot loader code size is %d\n", boot_size);
             if (valid) {
                 printf("Using original boot loader code.\n");
             } else {
                 printf("Unable to write new partition table.\n\n");
-                /* perhaps we should allow the user to specify a filename
-                   containing a valid boot loader */
+                free(ldrbuf);
                 return;
             }
         } else {
@@ -441,31 +519,29 @@ void write_ptable()
             /* shouldn't we do some pointer validations here as well? */
         }
     }
+    free(ldrbuf);
 
-    p = (int *) &hdbuf[ptoffs];
-    p = (int *) &hdbuf[*p];
+    b = &hdbuf[getword(&hdbuf[ptoffs])];
 
     for (i = 0; i < MAX_ENTRIES; ++i) {
         if (ptable[i].size == 0) {
-            *p++ = 0;
-            *p++ = 0;
-            *p++ = 0;
+            putword(b, 0);
+            putword(b+2, 0);
+            putword(b+4, 0);
         } else {
-            *p++ = ptable[i].start;
-            *p++ = ptable[i].size;
-            b = (unsigned char *) p++;
-            *b++ = ptable[i].type;
-            *b = ptable[i].bflag;
+            putword(b, ptable[i].start);
+            putword(b+2, ptable[i].size);
+            *(b+4) = ptable[i].type;
+            *(b+5) = ptable[i].bflag;
         }
+        b += 6;
     }
 
     /* copy the disk geometry values as well */
 
-    p = (int *) &hdbuf[goffs];
-    p = (int *) &hdbuf[*p];
-    b = (unsigned char *) p;
+    b = &hdbuf[getword(&hdbuf[goffs])];
     
-    *p = idecyls; /*hdcyls;*/
+    putword(b, idecyls); /*hdcyls;*/
     *(b+2) = (unsigned char) ideheads; /*hdheads;*/
     *(b+3) = (unsigned char) idesecs; /*hdsecs;*/
 
@@ -504,6 +580,179 @@ void write_ptable()
     printf("Done.\n\n");
 }
 
+/* Read/write sectors given their linear block address. The CHS address
+   is computed from the geometry stored in the partition table, the same
+   way the boot loader does it. */
+
+int lba2chs(unsigned long lba, int *cyl, int *head, int *sector)
+{
+    if ((hdsecs == 0) || (hdheads == 0)) return 1;
+    *sector = lba % hdsecs;
+    lba /= hdsecs;
+    *head = lba % hdheads;
+    *cyl = lba / hdheads;
+    return 0;
+}
+
+int lbaread(unsigned long lba, unsigned char *buf)
+{
+    int cyl, head, sector;
+
+    if (lba2chs(lba, &cyl, &head, &sector)) return 1;
+    return hdread(cyl, head, sector, buf);
+}
+
+int lbawrite(unsigned long lba, unsigned char *buf)
+{
+    int cyl, head, sector;
+
+    if (lba2chs(lba, &cyl, &head, &sector)) return 1;
+    return hdwrite(cyl, head, sector, buf);
+}
+
+/* Multi-sector versions, nsec must be 1-255 */
+
+int lbareadm(unsigned long lba, int nsec, unsigned char *buf)
+{
+    int cyl, head, sector;
+
+    if (lba2chs(lba, &cyl, &head, &sector)) return 1;
+    return hdreadm(cyl, head, sector, nsec, buf);
+}
+
+int lbawritem(unsigned long lba, int nsec, unsigned char *buf)
+{
+    int cyl, head, sector;
+
+    if (lba2chs(lba, &cyl, &head, &sector)) return 1;
+    return hdwritem(cyl, head, sector, nsec, buf);
+}
+
+/* Start an asynchronous read or write of nsec (1-255) sectors, the
+   transfer is then driven with hdpoll() and hdxfer(). Returns nonzero
+   if the drive is busy or the address is bad. */
+
+int lbastart(unsigned long lba, int nsec, int write)
+{
+    int cyl, head, sector;
+
+    if (lba2chs(lba, &cyl, &head, &sector)) return 1;
+    return hdstart(cyl, head, sector, nsec, write);
+}
+
+/* Load a boot loader image from a file and check that it is one of
+   ours for the given boot method. Returns the code size, or 0 if the
+   file could not be used. */
+
+int load_loader(char *name, int meth, unsigned char *buf)
+{
+    FILE *f;
+    int  i, size, fsize, max_size, pt, gm, sgn;
+
+    max_size = (meth == METHOD_BP) ? 1024 : 512;
+
+    f = fopen(name, "rb");
+    if (!f) return 0;
+    fsize = fread(buf, 1, max_size, f);
+    if (getc(f) != EOF) fsize = 0;  /* too big */
+    fclose(f);
+
+    /* CP/M files are a whole number of 128-byte records, drop the
+       ^Z or zero padding. The code may end with zeros too (an empty
+       partition table), those are added back below. */
+
+    size = fsize;
+    while ((size > 0) && ((buf[size-1] == 0x1A) || (buf[size-1] == 0))) --size;
+
+    if (meth == METHOD_BP) {
+        if ((size < 0x80) || (buf[0] != 0x76) || (buf[1] != 0x21)) return 0;
+        pt = 17;
+        gm = 19;
+        sgn = 8;
+    } else {
+        if ((size < 0x20) || (buf[0] != 0xC3)) return 0;
+        pt = 3;
+        gm = 5;
+        sgn = 7;
+    }
+
+    for (i = 0; i < 8; ++i) {
+        if (buf[i+sgn] != p112sign[i]) return 0;
+    }
+
+    /* the table and geometry pointers must fall inside the code */
+
+    i = getword(&buf[pt]);
+    if ((i < 7) || (i + MAX_ENTRIES * 6 > fsize)) return 0;
+    if (i + MAX_ENTRIES * 6 > size) size = i + MAX_ENTRIES * 6;
+    i = getword(&buf[gm]);
+    if ((i < 7) || (i + 4 > fsize)) return 0;
+    if (i + 4 > size) size = i + 4;
+    if ((meth == METHOD_STD) && (size == max_size)) return 0; /* no room for checksum */
+
+    /* the table and geometry are rewritten anyway, clear any padding */
+    for (i = size; i < fsize; ++i) buf[i] = 0;
+
+    return size;
+}
+
+void select_loader()
+{
+    char str[80];
+    unsigned char *buf;
+    int  i;
+
+    printf("Boot loader file (default %s): ", ldrname[method]);
+    fgets(str, 80, stdin);
+    i = strlen(str);
+    if ((i > 0) && (str[i-1] == '\n')) str[--i] = '\0';
+    if (i == 0) {
+        printf("Using default file %s\n\n", ldrname[method]);
+        ldrfile = NULL;
+        return;
+    }
+    strcpy(ldrpath, str);
+    ldrfile = ldrpath;
+
+    buf = malloc(1024);
+    if (buf && (load_loader(ldrfile, method, buf) == 0)) {
+        printf("Warning: %s is not a valid %s boot loader image.\n",
+               ldrfile, (method == METHOD_BP) ? "new-style" : "standard");
+    }
+    free(buf);
+    printf("\n");
+}
+
+/* Boot record words are little-endian and not aligned */
+
+unsigned int getword(unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+void putword(unsigned char *p, unsigned int w)
+{
+    p[0] = w & 0xFF;
+    p[1] = (w >> 8) & 0xFF;
+}
+
+/* Size in bytes of the boot record for the current method */
+
+int boot_size()
+{
+    return (method == METHOD_BP) ? 1024 : 512;
+}
+
+/* Return the size of partition n (0-based) in sectors and its first
+   sector in start, or 0 if the partition is not defined. */
+
+unsigned long part_extent(int n, unsigned long *start)
+{
+    if ((n < 0) || (n >= MAX_ENTRIES) || (ptable[n].size == 0)) return 0;
+    *start = (unsigned long) ptable[n].start * 16L;
+    return (unsigned long) ptable[n].size * 16L;
+}
+
 void change_units()
 {
     char *ustr;
@@ -776,10 +1025,49 @@ void toggle_bootable()
         return;
     }
 
+    /* make sure an UZI filesystem is sane before booting from it */
+
+    if (!ptable[n].bflag && (ptable[n].type == 0xD1) && !filename) {
+        if (uzi_check(n) != 0) {
+            printf("Mark partition %d bootable anyway (y/n)? ", n+1);
+            fgets(str, 20, stdin);
+            if (tolower(str[0]) != 'y') {
+                printf("\n");
+                return;
+            }
+        }
+    }
+
     ptable[n].bflag = !ptable[n].bflag;
     printf("\n");
 }
 
+void check_fs()
+{
+    int  n;
+    char str[20];
+
+    printf("Partition number (1-%d): ", MAX_ENTRIES);
+    fgets(str, 20, stdin);
+    n = atoi(str);
+    if ((n < 1) || (n > MAX_ENTRIES)) {
+        printf("Value out of range.\n\n");
+        return;
+    }
+    --n;
+
+    if (ptable[n].size == 0) {
+        printf("Partition %d does not exist yet.\n\n", n+1);
+        return;
+    }
+    if (ptable[n].type != 0xD1) {
+        printf("Partition %d is not an UZI partition.\n\n", n+1);
+        return;
+    }
+
+    uzi_check(n);
+}
+
 void toggle_method()
 {
     if (method == METHOD_BP) {
@@ -800,14 +1088,12 @@ void verify_table()
 {
     unsigned long allocsecs, hdsecs, ovlpsecs;
     unsigned int  cyls, heads, sectors;
-    int  *p, i, j;
-    char *b;
+    int  i, j;
+    unsigned char *b;
     
-    p = (int *) &hdbuf[goffs];
-    p = (int *) &hdbuf[*p];
-    b = (char *) p;
+    b = &hdbuf[getword(&hdbuf[goffs])];
     
-    cyls = *p;
+    cyls = getword(b);
     heads = *(b+2);
     sectors = *(b+3);
     
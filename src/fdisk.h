@@ -0,0 +1,123 @@
+/**************************************************************************
+
+  Definitions shared by the modules of the P112 FDISK utility.
+  Copyright (C) 2026, P112 FDISK contributors.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+***************************************************************************/
+
+#ifndef FDISK_H
+#define FDISK_H
+
+#define MAX_ENTRIES  8            /* partition table entries */
+
+/* States returned by hdpoll(), these must match HDBUSY..HDERR in
+   gideio.asz */
+
+#define HD_BUSY      0            /* command in progress */
+#define HD_DRQ       1            /* drive waiting for a sector transfer */
+#define HD_DONE      2            /* command completed */
+#define HD_ERR       3            /* command failed */
+
+/* Variables defined in fdisk.c */
+
+extern unsigned char hdbuf[];
+extern unsigned int hdcyls, hdheads, hdsecs;
+extern int valid;
+
+/* Functions defined in fdisk.c */
+
+extern void read_ptable();
+extern int  boot_size();
+extern unsigned long part_extent(int n, unsigned long *start);
+extern unsigned int getword(unsigned char *p);
+extern void putword(unsigned char *p, unsigned int w);
+extern int  lba2chs(unsigned long lba, int *cyl, int *head, int *sector);
+extern int  lbaread(unsigned long lba, unsigned char *buf);
+extern int  lbawrite(unsigned long lba, unsigned char *buf);
+extern int  lbareadm(unsigned long lba, int nsec, unsigned char *buf);
+extern int  lbawritem(unsigned long lba, int nsec, unsigned char *buf);
+extern int  lbastart(unsigned long lba, int nsec, int write);
+
+/* Functions defined in gideio.asz (hostio.c in the host version) */
+
+extern int  hdident(void *buf);
+extern int  hdread(int cyl, int head, int sector, unsigned char *buf);
+extern int  hdwrite(int cyl, int head, int sector, unsigned char *buf);
+extern int  hdreadm(int cyl, int head, int sector, int nsec, unsigned char *buf);
+extern int  hdwritem(int cyl, int head, int sector, int nsec, unsigned char *buf);
+extern int  hdstart(int cyl, int head, int sector, int nsec, int write);
+extern int  hdpoll();
+extern void hdxfer(unsigned char *buf);
+extern void hdintr(int on);
+
+/* Functions defined in bankio.asz (hostio.c in the host version) */
+
+extern unsigned bkpage(void *addr);
+extern int  bkxfer(unsigned long phys, unsigned char *buf,
+                   unsigned count, int dir);
+
+/* Functions defined in bankbuf.c */
+
+extern unsigned long bkinit(unsigned page, unsigned npages);
+extern unsigned long bkavail();
+extern int  bkget(unsigned long offs, unsigned char *buf, unsigned n);
+extern int  bkput(unsigned long offs, unsigned char *buf, unsigned n);
+
+/* Functions defined in timer.asz */
+
+extern int  tmstart();
+extern unsigned tmread();
+extern unsigned tmreset();
+extern int  tmwrap();
+extern void tmstop();
+
+/* Functions defined in fsck.c, scan.c and bench.c */
+
+extern int  uzi_check(int n);
+extern void scan_part();
+extern void benchmark();
+
+#ifdef HOST
+#include <sys/types.h>
+
+/* Functions defined in hostio.c */
+
+extern int  hdfd;
+extern int  hdopen(char *name, int create);
+extern int  hdcompressed();
+extern off_t hdsize();
+extern int  hdpread(unsigned char *buf, size_t n, off_t offs);
+extern int  hdpwrite(unsigned char *buf, size_t n, off_t offs);
+
+/* Functions defined in cimage.c */
+
+extern int  ci_open(int fd);
+extern int  ci_create(int fd, off_t size);
+extern off_t ci_size();
+extern int  ci_read(off_t offs, unsigned char *buf, size_t n);
+extern int  ci_write(off_t offs, unsigned char *buf, size_t n);
+
+/* Functions defined in imgtool.c and store.c */
+
+extern int  hostcmd(int argc, char *argv[]);
+extern int  cmd_usage(char *cmd);
+extern int  copy_range(int in, off_t ioffs, int out, off_t ooffs, off_t len);
+extern int  copy_from_image(off_t ioffs, int out, off_t ooffs, off_t len);
+extern int  cmd_store(int argc, char *argv[]);
+#endif
+
+#endif
@@ -0,0 +1,470 @@
+/**************************************************************************
+
+  UZI filesystem consistency check for the P112 FDISK utility.
+  Copyright (C) 2026, P112 FDISK contributors.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+***************************************************************************/
+
+/* Read-only check of an UZI filesystem: superblock, inode table, block
+   allocation, free list and link counts. Everything is done in a single
+   pass over the inode table: the inode table is read in order with
+   multi-sector commands, directory and indirect blocks are scanned as
+   they are found, and the mode and link count of every inode are kept
+   in memory for the final checks. Data area blocks are read a whole UZI
+   track (16 sectors) at a time into a local track buffer. If a banked
+   buffer region was set up (-b option), tracks pushed out of the local
+   buffer are kept there. No track is read whole twice; a block needed
+   again from a track that is no longer held is read on its own. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fdisk.h"
+
+#define SMOUNTED   12742    /* superblock magic */
+#define ROOTINODE  1
+#define DIRECT     18       /* direct blocks, then single and double indirect */
+
+#define F_MASK     0170000
+#define F_REG      0100000
+#define F_DIR      040000
+#define F_PIPE     010000
+#define F_BDEV     060000
+#define F_CDEV     020000
+
+#define TRKSECS    16
+#define INOSECS    4        /* inode table sectors per command */
+#define MAXSLOTS   32
+#define NOTRK      0xFFFF
+#define MAXMSG     40       /* errors reported in detail */
+
+#define W(p)  ((p)[0] | ((p)[1] << 8))
+
+#define BIT(m, n)  ((m)[(n) >> 3] & (1 << ((n) & 7)))
+#define SET(m, n)  ((m)[(n) >> 3] |= (1 << ((n) & 7)))
+
+static unsigned long pstart;          /* partition start and size, in sectors */
+static unsigned long psize;
+static unsigned char *ibuf;           /* inode table blocks */
+static unsigned ibase, icount;        /* first block in ibuf, and how many */
+static unsigned char *tbuf;           /* data area track */
+static unsigned tbtrk;                /* track in tbuf, or NOTRK */
+static unsigned char *tmap;           /* tracks already read whole */
+static unsigned char dbuf[512];       /* single block */
+static unsigned slots[MAXSLOTS];      /* track held by each bank slot */
+static unsigned nslots, ncached;
+
+static unsigned isize, fsize, ninodes;
+static unsigned char *bmap;           /* blocks in use */
+static unsigned char *amap;           /* allocated inodes */
+static unsigned char *dmap;           /* inodes that are directories */
+static unsigned char *refs;           /* directory references per inode */
+static unsigned char *links;          /* link count of each inode */
+                                      /* (both counts stop at 255) */
+static unsigned errors, nfiles, ndirs, nused;
+static unsigned ind[2][256];          /* indirect block contents */
+
+static void error(char *fmt, unsigned a, unsigned b, unsigned c)
+{
+    if (errors++ < MAXMSG) {
+        printf("  ");
+        printf(fmt, a, b, c);
+        printf("\n");
+    } else if (errors == MAXMSG + 1) {
+        printf("  ...\n");
+    }
+}
+
+/* Get the data area part of track trk, as first and last block + 1 */
+
+static void trkspan(unsigned trk, unsigned *first, unsigned *last)
+{
+    *first = trk * TRKSECS;
+    *last = *first + TRKSECS;
+    if (*first < isize) *first = isize;   /* the inode table is read apart */
+    if (*last > fsize) *last = fsize;
+}
+
+/* Return a pointer to data area block blk, valid until the next call.
+   If fill is set and the track of the block was not read yet, the
+   whole track is read into tbuf; the track there before is moved to
+   a free bank slot, if any. */
+
+static unsigned char *getblk(unsigned blk, int fill)
+{
+    unsigned trk, s, first, last;
+    unsigned long offs;
+
+    trk = blk / TRKSECS;
+    offs = (blk % TRKSECS) * 512;
+    if (trk == tbtrk) return tbuf + offs;
+    for (s = 0; s < ncached; ++s) {
+        if (slots[s] == trk) {
+            if (bkget((unsigned long) s * TRKSECS * 512 + offs, dbuf, 512))
+                return NULL;
+            return dbuf;
+        }
+    }
+    if (fill && !BIT(tmap, trk)) {
+        if ((tbtrk != NOTRK) && (ncached < nslots)) {
+            trkspan(tbtrk, &first, &last);
+            s = (first % TRKSECS) * 512;
+            if (bkput((unsigned long) ncached * TRKSECS * 512 + s,
+                      tbuf + s, (last - first) * 512) == 0) {
+                slots[ncached++] = tbtrk;
+            }
+        }
+        tbtrk = NOTRK;
+        trkspan(trk, &first, &last);
+        if (lbareadm(pstart + first, last - first,
+                     tbuf + (first % TRKSECS) * 512)) return NULL;
+        SET(tmap, trk);
+        tbtrk = trk;
+        return tbuf + offs;
+    }
+    if (lbaread(pstart + blk, dbuf)) return NULL;
+    return dbuf;
+}
+
+/* Get the inode ino. The inode table is read in order, INOSECS
+   sectors at a time. */
+
+static int getinode(unsigned ino, unsigned char *di)
+{
+    unsigned blk, n;
+
+    blk = 2 + ino / 8;
+    if ((blk < ibase) || (blk >= ibase + icount)) {
+        n = INOSECS - blk % INOSECS;
+        if (blk + n > isize) n = isize - blk;
+        if (lbareadm(pstart + blk, n, ibuf)) return 1;
+        ibase = blk;
+        icount = n;
+    }
+    memcpy(di, ibuf + (blk - ibase) * 512 + (ino % 8) * 64, 64);
+    return 0;
+}
+
+/* Mark a block as used by inode ino */
+
+static int markblk(unsigned blk, unsigned ino)
+{
+    if ((blk < isize) || (blk >= fsize)) {
+        error("Inode %u: block %u out of range", ino, blk, 0);
+        return 1;
+    }
+    if (BIT(bmap, blk)) {
+        error("Inode %u: block %u is used twice", ino, blk, 0);
+        return 1;
+    }
+    SET(bmap, blk);
+    ++nused;
+    return 0;
+}
+
+/* Scan the entries of a directory block */
+
+static void scandir(unsigned blk, unsigned ino)
+{
+    unsigned char *b;
+    unsigned i, d;
+
+    b = getblk(blk, 1);
+    if (!b) {
+        error("Inode %u: cannot read directory block %u", ino, blk, 0);
+        return;
+    }
+    for (i = 0; i < 512; i += 16) {
+        d = W(b + i);
+        if (d == 0) continue;
+        if (d >= ninodes) {
+            error("Directory inode %u: bad entry inode number %u", ino, d, 0);
+        } else if (refs[d] < 255) {
+            ++refs[d];
+        }
+    }
+}
+
+/* Walk the blocks of a file, marking all of them, including the
+   indirect ones, as used. The data blocks of directories are scanned
+   on the way. */
+
+static void walk(unsigned char *di, unsigned ino, int isdir)
+{
+    unsigned i, j, k, blk;
+    unsigned char *b;
+
+    for (i = 0; i < DIRECT + 2; ++i) {
+        blk = W(di + 24 + i * 2);
+        if (blk == 0) continue;
+        if (markblk(blk, ino)) continue;
+        if (i < DIRECT) {
+            if (isdir) scandir(blk, ino);
+            continue;
+        }
+
+        /* single (i == DIRECT) or double indirect block */
+
+        b = getblk(blk, 1);
+        if (!b) {
+            error("Inode %u: cannot read indirect block %u", ino, blk, 0);
+            continue;
+        }
+        for (j = 0; j < 256; ++j) ind[0][j] = W(b + j * 2);
+        for (j = 0; j < 256; ++j) {
+            blk = ind[0][j];
+            if (blk == 0) continue;
+            if (markblk(blk, ino)) continue;
+            if (i == DIRECT) {
+                if (isdir) scandir(blk, ino);
+                continue;
+            }
+            b = getblk(blk, 1);
+            if (!b) {
+                error("Inode %u: cannot read indirect block %u", ino, blk, 0);
+                continue;
+            }
+            for (k = 0; k < 256; ++k) ind[1][k] = W(b + k * 2);
+            for (k = 0; k < 256; ++k) {
+                blk = ind[1][k];
+                if (blk == 0) continue;
+                if (!markblk(blk, ino) && isdir) scandir(blk, ino);
+            }
+        }
+    }
+}
+
+/* Check the free block list against the blocks in use */
+
+static unsigned check_free(unsigned char *sb)
+{
+    unsigned char *b;
+    unsigned nfree, i, blk, next, count, nlnk;
+    unsigned list[50];
+
+    nfree = W(sb + 6);
+    for (i = 0; i < 50; ++i) list[i] = W(sb + 8 + i * 2);
+
+    count = 0;
+    nlnk = 0;
+    for (;;) {
+        if (nfree > 50) {
+            error("Bad free list block count %u", nfree, 0, 0);
+            break;
+        }
+        for (i = 1; i < nfree; ++i) {
+            blk = list[i];
+            if ((blk < isize) || (blk >= fsize)) {
+                error("Free block %u out of range", blk, 0, 0);
+            } else if (BIT(bmap, blk)) {
+                error("Free block %u is in use or listed twice", blk, 0, 0);
+            } else {
+                SET(bmap, blk);
+                ++count;
+            }
+        }
+        next = (nfree > 0) ? list[0] : 0;
+        if (next == 0) break;
+
+        /* the link block itself is free too */
+        if ((next < isize) || (next >= fsize) || BIT(bmap, next)) {
+            error("Bad free list link %u", next, 0, 0);
+            break;
+        }
+        SET(bmap, next);
+        ++count;
+        if (++nlnk > fsize) break;
+
+        b = getblk(next, 0);   /* link blocks are scattered */
+        if (!b) {
+            error("Cannot read free list block %u", next, 0, 0);
+            break;
+        }
+        nfree = W(b);
+        for (i = 0; i < 50; ++i) list[i] = W(b + 2 + i * 2);
+    }
+    return count;
+}
+
+/* Check the UZI filesystem in partition n (0-based). Returns the number
+   of errors found, or -1 if the check could not be done. */
+
+int uzi_check(int n)
+{
+    unsigned char sb[512], di[64];
+    unsigned i, mode, nlink, nfree, tfree, tinode, freeino, lost;
+
+    psize = part_extent(n, &pstart);
+    if (psize == 0) {
+        printf("Partition %d does not exist yet.\n\n", n + 1);
+        return -1;
+    }
+
+    ibuf = malloc(INOSECS * 512);
+    tbuf = malloc(TRKSECS * 512);
+    if (!ibuf || !tbuf) {
+        free(tbuf);
+        free(ibuf);
+        printf("Not enough memory.\n\n");
+        return -1;
+    }
+    ibase = icount = 0;
+    tbtrk = NOTRK;
+    nslots = bkavail() / (TRKSECS * 512L);
+    if (nslots > MAXSLOTS) nslots = MAXSLOTS;
+    ncached = 0;
+    bmap = amap = dmap = refs = links = tmap = NULL;
+    errors = nfiles = ndirs = nused = 0;
+
+    printf("Checking UZI filesystem on partition %d\n", n + 1);
+
+    /* superblock */
+
+    if (lbaread(pstart + 1, sb)) {
+        printf("  Cannot read the superblock: hard disk failure.\n");
+        goto fail;
+    }
+    isize = W(sb + 2);
+    fsize = W(sb + 4);
+    if (W(sb) != SMOUNTED) {
+        printf("  Bad superblock magic number, not an UZI filesystem?\n");
+        goto fail;
+    }
+    if ((fsize > psize) || (isize < 3) || (isize >= fsize)) {
+        printf("  Bad superblock: %u inode blocks, %u total blocks.\n",
+               isize, fsize);
+        goto fail;
+    }
+    ninodes = (isize - 2) * 8;
+    tfree = W(sb + 216);
+    tinode = W(sb + 218);
+
+    bmap = calloc((fsize + 7) / 8, 1);
+    amap = calloc((ninodes + 7) / 8, 1);
+    dmap = calloc((ninodes + 7) / 8, 1);
+    refs = calloc(ninodes, 1);
+    links = calloc(ninodes, 1);
+    tmap = calloc((fsize / TRKSECS + 8) / 8, 1);
+    if (!bmap || !amap || !dmap || !refs || !links || !tmap) {
+        printf("  Not enough memory.\n");
+        goto fail;
+    }
+
+    /* inodes, their blocks and directory entries */
+
+    freeino = 0;
+    for (i = ROOTINODE; i < ninodes; ++i) {
+        if (getinode(i, di)) {
+            printf("  Cannot read inode %u: hard disk failure.\n", i);
+            goto fail;
+        }
+        mode = W(di);
+        if (mode == 0) {
+            ++freeino;
+            continue;
+        }
+        SET(amap, i);
+        nlink = W(di + 2);
+        links[i] = (nlink < 255) ? nlink : 255;
+        switch (mode & F_MASK) {
+        case F_DIR:
+            SET(dmap, i);
+            ++ndirs;
+            walk(di, i, 1);
+            break;
+
+        case F_REG:
+        case F_PIPE:
+            ++nfiles;
+            walk(di, i, 0);
+            break;
+
+        case F_BDEV:
+        case F_CDEV:
+            ++nfiles;
+            break;
+
+        default:
+            error("Inode %u: bad mode %06o", i, mode, 0);
+            break;
+        }
+    }
+    if (!BIT(dmap, ROOTINODE)) {
+        error("Root inode %u is not a directory", ROOTINODE, 0, 0);
+    }
+
+    /* link counts */
+
+    for (i = ROOTINODE; i < ninodes; ++i) {
+        if (!BIT(amap, i)) {
+            if (refs[i] > 0) error("Unallocated inode %u is referenced", i, 0, 0);
+            continue;
+        }
+        if (refs[i] == 0) {
+            error("Inode %u is not referenced by any directory", i, 0, 0);
+        } else if ((links[i] != refs[i]) &&
+                   !((i == ROOTINODE) && (links[i] == refs[i] + 1))) {
+            /* mkfs may leave the root directory count one higher */
+            error("Inode %u: link count %u, should be %u", i, links[i], refs[i]);
+        }
+    }
+
+    /* free list */
+
+    nfree = check_free(sb);
+    lost = fsize - isize - nused - nfree;
+    if (lost > 0) {
+        error("%u blocks are neither in use nor free", lost, 0, 0);
+    }
+    if (nfree != tfree) {
+        error("Superblock free block count %u, should be %u", tfree, nfree, 0);
+    }
+    if (tinode != freeino) {
+        error("Superblock free inode count %u, should be %u", tinode, freeino, 0);
+    }
+
+    printf("  %u inodes, %u blocks\n", ninodes, fsize);
+    printf("  %u files, %u directories, %u used blocks, %u free blocks\n",
+           nfiles, ndirs, nused, nfree);
+    if (errors == 0)
+        printf("No errors found.\n\n");
+    else
+        printf("%u error%s found.\n\n", errors, (errors == 1) ? "" : "s");
+
+    free(tmap);
+    free(links);
+    free(refs);
+    free(dmap);
+    free(amap);
+    free(bmap);
+    free(tbuf);
+    free(ibuf);
+    return errors;
+
+fail:
+    free(tmap);
+    free(links);
+    free(refs);
+    free(dmap);
+    free(amap);
+    free(bmap);
+    free(tbuf);
+    free(ibuf);
+    printf("\n");
+    return -1;
+}
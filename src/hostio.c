@@ -0,0 +1,236 @@
+/**************************************************************************
+
+  Disk image access routines for the host version of the P112 FDISK
+  utility. These replace gideio.asz and bankio.asz.
+  Copyright (C) 2026, P112 FDISK contributors.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+***************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "fdisk.h"
+
+/* The image is a plain dump of the disk, sector 0 first, or a chunked
+   compressed image (see cimage.c). Its geometry is taken from the boot
+   record if it has a valid P112 one, otherwise a 16 heads, 32 sectors
+   per track geometry is made up from the image size. */
+
+#define DEF_HEADS  16
+#define DEF_SECS   32
+
+int hdfd = -1;                   /* also used by imgtool.c */
+static int cimg;                 /* set if the image is compressed */
+static unsigned int ncyls, nheads, nspt;
+
+static unsigned char *physmem;   /* emulated physical memory */
+
+/* State of the emulated asynchronous command */
+
+static off_t xoffs;              /* image offset of the next sector */
+static int xcnt, xdir, xerr;
+
+/* Get the geometry stored in a boot record, returns 0 if none found */
+
+static int bootgeom(unsigned char *b)
+{
+    unsigned int g;
+
+    if ((b[0] == 0x76) && (b[1] == 0x21) &&
+        (memcmp(&b[8], "P112GIDE", 8) == 0)) {
+        g = getword(&b[19]);
+    } else if ((b[0] == 0xC3) && (memcmp(&b[7], "P112GIDE", 8) == 0)) {
+        g = getword(&b[5]);
+    } else {
+        return 0;
+    }
+    if ((g < 7) || (g + 4 > 1024)) return 0;
+    if ((b[g+2] == 0) || (b[g+3] == 0) || (getword(&b[g]) == 0)) return 0;
+
+    ncyls = getword(&b[g]);
+    nheads = b[g+2];
+    nspt = b[g+3];
+    return 1;
+}
+
+/* Open a disk image, optionally creating it. Returns 0 on success. */
+
+int hdopen(char *name, int create)
+{
+    unsigned char b[1024];
+    struct stat st;
+
+    if (hdfd >= 0) close(hdfd);
+    hdfd = open(name, create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0666);
+    if (hdfd < 0) return 1;
+
+    cimg = ci_open(hdfd);
+    if (cimg < 0) return 1;
+
+    if (hdpread(b, sizeof(b), 0)) return 1;
+    if (!bootgeom(b)) {
+        if (fstat(hdfd, &st) < 0) return 1;
+        nheads = DEF_HEADS;
+        nspt = DEF_SECS;
+        ncyls = (cimg ? ci_size() : st.st_size) / (DEF_HEADS * DEF_SECS * 512L);
+        if (ncyls == 0) ncyls = 1;
+    }
+    return 0;
+}
+
+int hdcompressed()
+{
+    return cimg;
+}
+
+/* Size in bytes of the image contents */
+
+off_t hdsize()
+{
+    struct stat st;
+
+    if (hdfd < 0) return 0;
+    if (cimg) return ci_size();
+    if (fstat(hdfd, &st) < 0) return 0;
+    return st.st_size;
+}
+
+/* Read/write at a byte offset of the image, reads past the end of
+   the image return zeros */
+
+int hdpread(unsigned char *buf, size_t n, off_t offs)
+{
+    ssize_t k;
+
+    if (hdfd < 0) return 1;
+    if (cimg) return ci_read(offs, buf, n);
+    k = pread(hdfd, buf, n, offs);
+    if (k < 0) return 1;
+    if (k < n) memset(buf + k, 0, n - k);
+    return 0;
+}
+
+int hdpwrite(unsigned char *buf, size_t n, off_t offs)
+{
+    if (hdfd < 0) return 1;
+    if (cimg) return ci_write(offs, buf, n);
+    return pwrite(hdfd, buf, n, offs) != n;
+}
+
+/* Emulate the IDE identify command, only the geometry is filled in */
+
+int hdident(void *buf)
+{
+    unsigned short id[57];
+
+    if (hdfd < 0) return 1;
+    memset(id, 0, sizeof(id));
+    id[1] = ncyls;
+    id[3] = nheads;
+    id[5] = 512;
+    id[6] = nspt;
+    id[54] = ncyls;
+    id[55] = nheads;
+    id[56] = nspt;
+    memcpy(buf, id, sizeof(id));
+    return 0;
+}
+
+static off_t secoffs(int cyl, int head, int sector)
+{
+    return ((((off_t) cyl * nheads) + head) * nspt + sector) * 512;
+}
+
+int hdread(int cyl, int head, int sector, unsigned char *buf)
+{
+    return hdpread(buf, 512, secoffs(cyl, head, sector));
+}
+
+int hdwrite(int cyl, int head, int sector, unsigned char *buf)
+{
+    return hdpwrite(buf, 512, secoffs(cyl, head, sector));
+}
+
+int hdreadm(int cyl, int head, int sector, int nsec, unsigned char *buf)
+{
+    return hdpread(buf, nsec * 512, secoffs(cyl, head, sector));
+}
+
+int hdwritem(int cyl, int head, int sector, int nsec, unsigned char *buf)
+{
+    return hdpwrite(buf, nsec * 512, secoffs(cyl, head, sector));
+}
+
+/* Asynchronous interface. The image is always ready, so every sector
+   is moved synchronously by hdxfer(). */
+
+int hdstart(int cyl, int head, int sector, int nsec, int write)
+{
+    xoffs = secoffs(cyl, head, sector);
+    xcnt = nsec;
+    xdir = write;
+    xerr = (hdfd < 0);
+    return 0;
+}
+
+int hdpoll()
+{
+    if (xerr) return HD_ERR;
+    return (xcnt > 0) ? HD_DRQ : HD_DONE;
+}
+
+void hdxfer(unsigned char *buf)
+{
+    if (xcnt <= 0) return;
+    if (xdir)
+        xerr = hdpwrite(buf, 512, xoffs);
+    else
+        xerr = hdpread(buf, 512, xoffs);
+    xoffs += 512;
+    --xcnt;
+}
+
+void hdintr(int on)
+{
+}
+
+/* Banked memory emulation. The program is assumed to live in the
+   first 64K of a 1M physical address space. */
+
+unsigned bkpage(void *addr)
+{
+    return 0;
+}
+
+int bkxfer(unsigned long phys, unsigned char *buf, unsigned count, int dir)
+{
+    if (!physmem) {
+        physmem = calloc(1, 0x100000L);
+        if (!physmem) return 1;
+    }
+    if (phys + count > 0x100000L) return 1;
+    if (dir)
+        memcpy(physmem + phys, buf, count);
+    else
+        memcpy(buf, physmem + phys, count);
+    return 0;
+}
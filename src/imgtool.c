@@ -0,0 +1,399 @@
+/**************************************************************************
+
+  Disk image commands for the host version of the P112 FDISK utility.
+  Copyright (C) 2026, P112 FDISK contributors.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+***************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "fdisk.h"
+
+static int cmd_assemble(int argc, char *argv[]);
+static int cmd_extract(int argc, char *argv[]);
+static int cmd_compress(int argc, char *argv[]);
+static int cmd_decompress(int argc, char *argv[]);
+static int cmd_check(int argc, char *argv[]);
+
+struct {
+    char *name;
+    int  (*func)(int argc, char *argv[]);
+    char *args;
+} host_cmds[] = {
+    "assemble", cmd_assemble, "<image> <layout> [<n>=<file>...]",
+    "extract",  cmd_extract,  "<image> [<n>=<file>...]",
+    "compress", cmd_compress, "<image> <cimage>",
+    "decompress", cmd_decompress, "<cimage> <image>",
+    "check",    cmd_check,    "<image> <n>",
+    "store",    cmd_store,    "<dir> add <image> <name> | <dir> get <name> <image>"
+};
+
+#define NUM_CMDS  sizeof(host_cmds)/sizeof(host_cmds[0])
+
+/* Run a non-interactive command. Returns the program exit code, or -1
+   if argv[0] is not a command name. */
+
+int hostcmd(int argc, char *argv[])
+{
+    int i;
+
+    for (i = 0; i < NUM_CMDS; ++i) {
+        if (strcmp(argv[0], host_cmds[i].name) == 0)
+            return host_cmds[i].func(argc, argv);
+    }
+    return -1;
+}
+
+int cmd_usage(char *cmd)
+{
+    int i;
+
+    for (i = 0; i < NUM_CMDS; ++i) {
+        if (strcmp(cmd, host_cmds[i].name) == 0)
+            fprintf(stderr, "Usage: hfdisk %s %s\n", cmd, host_cmds[i].args);
+    }
+    return 1;
+}
+
+/* Copy len bytes with copy_file_range, which lets the filesystem share
+   the blocks (reflink) or copy them in-kernel. Falls back to a plain
+   copy where it is not supported, skipping all-zero blocks so they are
+   left as holes in the output. */
+
+static int copy_data(int in, off_t ioffs, int out, off_t ooffs, off_t len)
+{
+    static char buf[65536];
+    ssize_t n;
+    size_t  chunk;
+    int i;
+
+    while (len > 0) {
+        n = copy_file_range(in, &ioffs, out, &ooffs, len, 0);
+        if (n > 0) {
+            len -= n;
+            continue;
+        }
+        if (n == 0) return 0;  /* input ended early */
+        if ((errno != EXDEV) && (errno != EINVAL) &&
+            (errno != ENOSYS) && (errno != EOPNOTSUPP)) return 1;
+        break;
+    }
+
+    while (len > 0) {
+        chunk = (len > sizeof(buf)) ? sizeof(buf) : len;
+        n = pread(in, buf, chunk, ioffs);
+        if (n < 0) return 1;
+        if (n == 0) return 0;
+        for (i = 0; (i < n) && (buf[i] == 0); ++i) ;
+        if ((i < n) && (pwrite(out, buf, n, ooffs) != n)) return 1;
+        ioffs += n;
+        ooffs += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Copy a byte range between two files, transferring only the data
+   extents of the input. The output must have been extended already
+   (with ftruncate) so the skipped holes read as zeros. */
+
+int copy_range(int in, off_t ioffs, int out, off_t ooffs, off_t len)
+{
+    off_t end, data, hole;
+
+    end = ioffs + len;
+    while (ioffs < end) {
+        data = lseek(in, ioffs, SEEK_DATA);
+        if (data < 0) {
+            if (errno == ENXIO) return 0;  /* only a hole remains */
+            data = ioffs;                  /* no SEEK_DATA support */
+            hole = end;
+        } else {
+            if (data >= end) return 0;
+            hole = lseek(in, data, SEEK_HOLE);
+            if ((hole < 0) || (hole > end)) hole = end;
+        }
+        if (copy_data(in, data, out, ooffs + (data - ioffs), hole - data))
+            return 1;
+        ooffs += hole - ioffs;
+        ioffs = hole;
+    }
+    return 0;
+}
+
+/* Copy len bytes from the open image to a file. Used for compressed
+   images, which cannot be copied with copy_range(); all-zero blocks
+   are skipped so they are left as holes in the output. */
+
+int copy_from_image(off_t ioffs, int out, off_t ooffs, off_t len)
+{
+    static unsigned char buf[8192];
+    size_t chunk;
+    int i;
+
+    while (len > 0) {
+        chunk = (len > sizeof(buf)) ? sizeof(buf) : len;
+        if (hdpread(buf, chunk, ioffs)) return 1;
+        for (i = 0; (i < chunk) && (buf[i] == 0); ++i) ;
+        if ((i < chunk) && (pwrite(out, buf, chunk, ooffs) != chunk)) return 1;
+        ioffs += chunk;
+        ooffs += chunk;
+        len -= chunk;
+    }
+    return 0;
+}
+
+/* Parse a <n>=<file> argument, returns the partition index or -1 */
+
+static int part_arg(char *arg, char **file)
+{
+    char *p;
+    int  n;
+
+    p = strchr(arg, '=');
+    if (!p || (p == arg)) return -1;
+    n = atoi(arg);
+    if ((n < 1) || (n > MAX_ENTRIES)) return -1;
+    *file = p + 1;
+    return n - 1;
+}
+
+/* Build a disk image from a boot record (as written by fdisk to a file)
+   and a payload file for each partition. The image is created sparse,
+   with the full size given by the boot record geometry. */
+
+static int cmd_assemble(int argc, char *argv[])
+{
+    int  i, n, fd, bsize;
+    char *file;
+    unsigned long start, size;
+    struct stat st;
+    FILE *f;
+
+    if (argc < 3) return cmd_usage(argv[0]);
+
+    f = fopen(argv[2], "rb");
+    if (!f) {
+        fprintf(stderr, "Could not open file %s.\n", argv[2]);
+        return 1;
+    }
+    memset(hdbuf, 0, 1024);
+    if (fread(hdbuf, 1, 1024, f) < 512) {
+        fprintf(stderr, "Error reading file %s.\n", argv[2]);
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+
+    read_ptable();
+    if (!valid) return 1;
+
+    if (hdopen(argv[1], 1)) {
+        fprintf(stderr, "Could not create file %s.\n", argv[1]);
+        return 1;
+    }
+
+    bsize = boot_size();
+    if ((ftruncate(hdfd, (off_t) hdcyls * hdheads * hdsecs * 512) < 0) ||
+        (pwrite(hdfd, hdbuf, bsize, 0) != bsize)) {
+        fprintf(stderr, "Error writing file %s.\n", argv[1]);
+        return 1;
+    }
+
+    for (i = 3; i < argc; ++i) {
+        n = part_arg(argv[i], &file);
+        if (n < 0) return cmd_usage(argv[0]);
+        size = part_extent(n, &start);
+        if (size == 0) {
+            fprintf(stderr, "Partition %d is not defined.\n", n + 1);
+            return 1;
+        }
+        fd = open(file, O_RDONLY);
+        if ((fd < 0) || (fstat(fd, &st) < 0)) {
+            fprintf(stderr, "Could not open file %s.\n", file);
+            return 1;
+        }
+        if (st.st_size > (off_t) size * 512) {
+            fprintf(stderr, "File %s does not fit in partition %d.\n",
+                    file, n + 1);
+            close(fd);
+            return 1;
+        }
+        if (copy_range(fd, 0, hdfd, (off_t) start * 512, st.st_size)) {
+            fprintf(stderr, "Error copying %s to partition %d.\n", file, n + 1);
+            close(fd);
+            return 1;
+        }
+        close(fd);
+    }
+
+    close(hdfd);
+    return 0;
+}
+
+/* Extract partitions from a disk image into separate files */
+
+static int cmd_extract(int argc, char *argv[])
+{
+    int  i, n, fd;
+    char *file;
+    unsigned long start, size;
+
+    if (argc < 2) return cmd_usage(argv[0]);
+
+    if (hdopen(argv[1], 0)) {
+        fprintf(stderr, "Could not open file %s.\n", argv[1]);
+        return 1;
+    }
+    if (hdread(0, 0, 0, hdbuf) || hdread(0, 0, 1, hdbuf+512)) {
+        fprintf(stderr, "Error reading file %s.\n", argv[1]);
+        return 1;
+    }
+
+    read_ptable();
+    if (!valid) return 1;
+
+    for (i = 2; i < argc; ++i) {
+        n = part_arg(argv[i], &file);
+        if (n < 0) return cmd_usage(argv[0]);
+        size = part_extent(n, &start);
+        if (size == 0) {
+            fprintf(stderr, "Partition %d is not defined.\n", n + 1);
+            return 1;
+        }
+        fd = open(file, O_RDWR | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            fprintf(stderr, "Could not create file %s.\n", file);
+            return 1;
+        }
+        if ((ftruncate(fd, (off_t) size * 512) < 0) ||
+            (hdcompressed() ?
+             copy_from_image((off_t) start * 512, fd, 0, (off_t) size * 512) :
+             copy_range(hdfd, (off_t) start * 512, fd, 0, (off_t) size * 512))) {
+            fprintf(stderr, "Error extracting partition %d to %s.\n", n + 1, file);
+            close(fd);
+            return 1;
+        }
+        close(fd);
+    }
+
+    return 0;
+}
+
+/* Convert a plain disk image to the compressed format. Only the data
+   extents of the input are read, holes become empty chunks. */
+
+static int cmd_compress(int argc, char *argv[])
+{
+    static unsigned char buf[8192];
+    int   in, out, i;
+    off_t offs, data;
+    ssize_t n;
+    struct stat st;
+
+    if (argc < 3) return cmd_usage(argv[0]);
+
+    in = open(argv[1], O_RDONLY);
+    if ((in < 0) || (fstat(in, &st) < 0)) {
+        fprintf(stderr, "Could not open file %s.\n", argv[1]);
+        return 1;
+    }
+    out = open(argv[2], O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if ((out < 0) || ci_create(out, st.st_size)) {
+        fprintf(stderr, "Could not create file %s.\n", argv[2]);
+        return 1;
+    }
+
+    for (offs = 0; offs < st.st_size; offs += n) {
+        data = lseek(in, offs, SEEK_DATA);
+        if (data < 0) {
+            if (errno == ENXIO) break;
+            data = offs;
+        }
+        offs = data - (data % sizeof(buf));
+        n = pread(in, buf, sizeof(buf), offs);
+        if (n <= 0) break;
+        for (i = 0; (i < n) && (buf[i] == 0); ++i) ;
+        if ((i < n) && ci_write(offs, buf, n)) {
+            fprintf(stderr, "Error writing file %s.\n", argv[2]);
+            return 1;
+        }
+    }
+
+    close(in);
+    close(out);
+    return 0;
+}
+
+/* Convert a compressed image back to a plain (sparse) one */
+
+static int cmd_decompress(int argc, char *argv[])
+{
+    int out;
+
+    if (argc < 3) return cmd_usage(argv[0]);
+
+    if (hdopen(argv[1], 0) || !hdcompressed()) {
+        fprintf(stderr, "%s is not a compressed image.\n", argv[1]);
+        return 1;
+    }
+    out = open(argv[2], O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (out < 0) {
+        fprintf(stderr, "Could not create file %s.\n", argv[2]);
+        return 1;
+    }
+    if ((ftruncate(out, ci_size()) < 0) ||
+        copy_from_image(0, out, 0, ci_size())) {
+        fprintf(stderr, "Error writing file %s.\n", argv[2]);
+        return 1;
+    }
+
+    close(out);
+    return 0;
+}
+
+/* Check the UZI filesystem in partition n of an image */
+
+static int cmd_check(int argc, char *argv[])
+{
+    int n;
+
+    if (argc < 3) return cmd_usage(argv[0]);
+    n = atoi(argv[2]);
+    if ((n < 1) || (n > MAX_ENTRIES)) return cmd_usage(argv[0]);
+
+    if (hdopen(argv[1], 0)) {
+        fprintf(stderr, "Could not open file %s.\n", argv[1]);
+        return 1;
+    }
+    if (hdread(0, 0, 0, hdbuf) || hdread(0, 0, 1, hdbuf+512)) {
+        fprintf(stderr, "Error reading file %s.\n", argv[1]);
+        return 1;
+    }
+
+    read_ptable();
+    if (!valid) return 1;
+
+    return uzi_check(n - 1) != 0;
+}
@@ -0,0 +1,108 @@
+/**************************************************************************
+
+  Partition read scan and checksum for the P112 FDISK utility.
+  Copyright (C) 2026, P112 FDISK contributors.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+***************************************************************************/
+
+/* Reads every sector of a partition, reports the tracks that cannot be
+   read and computes the BSD checksum of the contents (as printed by the
+   Unix "sum -r" command), so that a partition can be compared with the
+   file it was copied from. Each track is read with one multi-sector
+   command through the asynchronous GIDE interface: a sector is added
+   to the checksum while the drive is fetching the next one, and the
+   progress line is printed while the drive seeks to the next track. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fdisk.h"
+
+#define TRKSECS    16       /* sectors per command (1 UZI track) */
+#define MAXBAD     20       /* bad tracks reported in detail */
+
+static unsigned bsdsum(unsigned sum, unsigned char *p, unsigned n)
+{
+    while (n-- > 0) {
+        sum = (sum >> 1) | ((sum & 1) << 15);
+        sum = (sum + *p++) & 0xFFFF;
+    }
+    return sum;
+}
+
+void scan_part()
+{
+    int  n, st;
+    unsigned trk, ntrk, sum, nbad;
+    unsigned long start, size;
+    unsigned char *sbuf;
+    char str[20];
+
+    printf("Partition number (1-%d): ", MAX_ENTRIES);
+    fgets(str, 20, stdin);
+    n = atoi(str);
+    if ((n < 1) || (n > MAX_ENTRIES)) {
+        printf("Value out of range.\n\n");
+        return;
+    }
+    size = part_extent(n - 1, &start);
+    if (size == 0) {
+        printf("Partition %d does not exist yet.\n\n", n);
+        return;
+    }
+
+    sbuf = malloc(512);
+    if (!sbuf) {
+        printf("Not enough memory.\n\n");
+        return;
+    }
+
+    ntrk = size / TRKSECS;
+    sum = 0;
+    nbad = 0;
+    for (trk = 0; trk < ntrk; ++trk) {
+        if (lbastart(start + (unsigned long) trk * TRKSECS, TRKSECS, 0)) {
+            printf("\nHard disk failure, scan aborted.\n\n");
+            free(sbuf);
+            return;
+        }
+        if ((trk % 16) == 0) {
+            printf("\r  Track %u of %u", trk, ntrk);
+            fflush(stdout);
+        }
+        while ((st = hdpoll()) != HD_DONE) {
+            if (st == HD_ERR) break;
+            if (st == HD_DRQ) {
+                hdxfer(sbuf);
+                sum = bsdsum(sum, sbuf, 512);
+            }
+        }
+        if (st == HD_ERR) {
+            if (nbad++ < MAXBAD) printf("\r  Read error in track %u\n", trk);
+        }
+    }
+    printf("\r  Track %u of %u\n", ntrk, ntrk);
+
+    if (nbad > 0) {
+        printf("%u unreadable track%s, no checksum.\n\n",
+               nbad, (nbad == 1) ? "" : "s");
+    } else {
+        printf("Checksum %05u, %lu KB (as \"sum -r\" on the partition contents)\n\n",
+               sum, size / 2);
+    }
+    free(sbuf);
+}
@@ -0,0 +1,339 @@
+/**************************************************************************
+
+  Content-addressed partition store for the host version of the P112
+  FDISK utility.
+  Copyright (C) 2026, P112 FDISK contributors.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+***************************************************************************/
+
+/* Disk images are split into their boot record and partitions, each
+   stored once under its SHA-256 hash:
+
+     <dir>/objects/<2 hex digits>/<62 hex digits>
+     <dir>/images/<name>
+
+   The image file is a text manifest listing the image size and the
+   hashes of the boot record and of each partition. Unpartitioned space
+   is not stored, and reads back as zeros. */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "fdisk.h"
+
+#define HASHLEN      65     /* hex digits plus terminator */
+
+/*------------------------------------------------------------------------*/
+
+/* SHA-256, as in FIPS 180-2 */
+
+struct sha256 {
+    unsigned int  h[8];
+    unsigned char blk[64];
+    unsigned long long len;
+};
+
+static const unsigned int sha_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROR(x, n)  (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha_block(struct sha256 *s)
+{
+    unsigned int w[64], a, b, c, d, e, f, g, h, t1, t2;
+    int i;
+
+    for (i = 0; i < 16; ++i) {
+        w[i] = ((unsigned int) s->blk[i*4] << 24) |
+               ((unsigned int) s->blk[i*4+1] << 16) |
+               ((unsigned int) s->blk[i*4+2] << 8) | s->blk[i*4+3];
+    }
+    for (i = 16; i < 64; ++i) {
+        w[i] = w[i-16] + w[i-7] +
+               (ROR(w[i-15], 7) ^ ROR(w[i-15], 18) ^ (w[i-15] >> 3)) +
+               (ROR(w[i-2], 17) ^ ROR(w[i-2], 19) ^ (w[i-2] >> 10));
+    }
+
+    a = s->h[0]; b = s->h[1]; c = s->h[2]; d = s->h[3];
+    e = s->h[4]; f = s->h[5]; g = s->h[6]; h = s->h[7];
+    for (i = 0; i < 64; ++i) {
+        t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) +
+             ((e & f) ^ (~e & g)) + sha_k[i] + w[i];
+        t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) +
+             ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    s->h[0] += a; s->h[1] += b; s->h[2] += c; s->h[3] += d;
+    s->h[4] += e; s->h[5] += f; s->h[6] += g; s->h[7] += h;
+}
+
+static void sha_init(struct sha256 *s)
+{
+    static const unsigned int h0[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    memcpy(s->h, h0, sizeof(h0));
+    s->len = 0;
+}
+
+static void sha_update(struct sha256 *s, unsigned char *p, size_t n)
+{
+    while (n-- > 0) {
+        s->blk[s->len++ % 64] = *p++;
+        if (s->len % 64 == 0) sha_block(s);
+    }
+}
+
+static void sha_final(struct sha256 *s, char *hex)
+{
+    unsigned long long bits;
+    unsigned char pad;
+    int i;
+
+    bits = s->len * 8;
+    pad = 0x80;
+    sha_update(s, &pad, 1);
+    pad = 0;
+    while (s->len % 64 != 56) sha_update(s, &pad, 1);
+    for (i = 7; i >= 0; --i) {
+        pad = bits >> (i * 8);
+        sha_update(s, &pad, 1);
+    }
+    for (i = 0; i < 8; ++i) sprintf(hex + i * 8, "%08x", s->h[i]);
+}
+
+/*------------------------------------------------------------------------*/
+
+static char *objpath(char *dir, char *hash)
+{
+    static char path[1024];
+
+    snprintf(path, sizeof(path), "%s/objects/%.2s/%s", dir, hash, hash + 2);
+    return path;
+}
+
+/* Hash len bytes of the open image starting at offs */
+
+static int hash_image(off_t offs, off_t len, char *hash)
+{
+    static unsigned char buf[65536];
+    struct sha256 s;
+    size_t n;
+
+    sha_init(&s);
+    while (len > 0) {
+        n = (len > sizeof(buf)) ? sizeof(buf) : len;
+        if (hdpread(buf, n, offs)) return 1;
+        sha_update(&s, buf, n);
+        offs += n;
+        len -= n;
+    }
+    sha_final(&s, hash);
+    return 0;
+}
+
+/* Store len bytes of the open image as an object, unless an object with
+   the same hash is already there. Returns 0 on success. */
+
+static int put_object(char *dir, off_t offs, off_t len, char *hash)
+{
+    char path[1024], tmp[1024];
+    struct stat st;
+    int  fd, err;
+
+    if (hash_image(offs, len, hash)) return 1;
+    strcpy(path, objpath(dir, hash));
+    if (stat(path, &st) == 0) return 0;  /* already stored */
+
+    snprintf(tmp, sizeof(tmp), "%s/objects/%.2s", dir, hash);
+    if ((mkdir(tmp, 0777) < 0) && (errno != EEXIST)) return 1;
+    snprintf(tmp, sizeof(tmp), "%s/objects/tmpXXXXXX", dir);
+    fd = mkstemp(tmp);
+    if (fd < 0) return 1;
+
+    /* mkstemp creates the file for the owner only */
+    err = (fchmod(fd, 0644) < 0) || (ftruncate(fd, len) < 0) ||
+          (hdcompressed() ? copy_from_image(offs, fd, 0, len) :
+                            copy_range(hdfd, offs, fd, 0, len));
+    close(fd);
+    if (err || (rename(tmp, path) < 0)) {
+        unlink(tmp);
+        return 1;
+    }
+    return 0;
+}
+
+/* Add an image to the store */
+
+static int store_add(char *dir, char *image, char *name)
+{
+    char path[1024], hash[HASHLEN];
+    unsigned long start, size;
+    FILE *f;
+    int  i;
+
+    if (hdopen(image, 0) || hdread(0, 0, 0, hdbuf) || hdread(0, 0, 1, hdbuf+512)) {
+        fprintf(stderr, "Could not read file %s.\n", image);
+        return 1;
+    }
+    read_ptable();
+    if (!valid) return 1;
+
+    snprintf(path, sizeof(path), "%s/images/%s", dir, name);
+    f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Could not create file %s.\n", path);
+        return 1;
+    }
+    fprintf(f, "p112store 1\n");
+    fprintf(f, "size %llu\n", (unsigned long long) hdsize());
+
+    if (put_object(dir, 0, boot_size(), hash)) goto err;
+    fprintf(f, "boot %s %d\n", hash, boot_size());
+
+    for (i = 0; i < MAX_ENTRIES; ++i) {
+        size = part_extent(i, &start);
+        if (size == 0) continue;
+        if (put_object(dir, (off_t) start * 512, (off_t) size * 512, hash))
+            goto err;
+        fprintf(f, "part %d %s %lu\n", i + 1, hash, size);
+    }
+
+    if (fclose(f) == 0) return 0;
+    f = NULL;
+
+err:
+    fprintf(stderr, "Error storing image %s.\n", image);
+    if (f) fclose(f);
+    unlink(path);
+    return 1;
+}
+
+/* Copy a whole object file to the given offset of the open image */
+
+static int get_object(char *dir, char *hash, off_t offs, off_t len)
+{
+    struct stat st;
+    int  fd, err;
+
+    fd = open(objpath(dir, hash), O_RDONLY);
+    if (fd < 0) return 1;
+    err = (fstat(fd, &st) < 0) || (st.st_size != len) ||
+          copy_range(fd, 0, hdfd, offs, len);
+    close(fd);
+    return err;
+}
+
+/* Reconstruct an image from the store */
+
+static int store_get(char *dir, char *name, char *image)
+{
+    char path[1024], key[16], hash[HASHLEN];
+    unsigned long long imgsize;
+    unsigned long start, size, n;
+    FILE *f, *b;
+    int  i, bsize;
+
+    snprintf(path, sizeof(path), "%s/images/%s", dir, name);
+    f = fopen(path, "r");
+    if (!f || (fscanf(f, "p112store 1 size %llu boot %64s %d",
+                      &imgsize, hash, &bsize) != 3)) {
+        fprintf(stderr, "Could not read image %s from the store.\n", name);
+        if (f) fclose(f);
+        return 1;
+    }
+
+    /* the partition offsets come from the stored boot record */
+
+    memset(hdbuf, 0, 1024);
+    b = fopen(objpath(dir, hash), "rb");
+    if (!b || (bsize > 1024) || (fread(hdbuf, 1, bsize, b) != bsize)) {
+        fprintf(stderr, "Missing boot record object %s.\n", hash);
+        if (b) fclose(b);
+        fclose(f);
+        return 1;
+    }
+    fclose(b);
+    read_ptable();
+
+    if (hdopen(image, 1) || (ftruncate(hdfd, imgsize) < 0) ||
+        (pwrite(hdfd, hdbuf, bsize, 0) != bsize)) {
+        fprintf(stderr, "Could not create file %s.\n", image);
+        fclose(f);
+        return 1;
+    }
+
+    while (fscanf(f, "%15s %d %64s %lu", key, &i, hash, &n) == 4) {
+        size = part_extent(i - 1, &start);
+        if ((strcmp(key, "part") != 0) || (size != n) ||
+            get_object(dir, hash, (off_t) start * 512, (off_t) size * 512)) {
+            fprintf(stderr, "Error restoring partition %d.\n", i);
+            fclose(f);
+            return 1;
+        }
+    }
+
+    fclose(f);
+
+    /* partitions may extend past the end of the original image */
+    if (ftruncate(hdfd, imgsize) < 0) {
+        fprintf(stderr, "Could not write file %s.\n", image);
+        return 1;
+    }
+    close(hdfd);
+    return 0;
+}
+
+/* store <dir> add <image> <name>
+   store <dir> get <name> <image> */
+
+int cmd_store(int argc, char *argv[])
+{
+    char path[1024];
+
+    if (argc < 5) return cmd_usage(argv[0]);
+
+    snprintf(path, sizeof(path), "%s/objects", argv[1]);
+    mkdir(argv[1], 0777);
+    mkdir(path, 0777);
+    snprintf(path, sizeof(path), "%s/images", argv[1]);
+    mkdir(path, 0777);
+
+    if (strcmp(argv[2], "add") == 0) return store_add(argv[1], argv[3], argv[4]);
+    if (strcmp(argv[2], "get") == 0) return store_get(argv[1], argv[3], argv[4]);
+    return cmd_usage(argv[0]);
+}